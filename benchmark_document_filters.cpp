@@ -0,0 +1,104 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+#include "benchmark_utils.h"
+
+using namespace std;
+
+// Compares ready-made filters with equivalent lambdas, both are checked against
+// the document data stored in every scanned posting
+
+namespace {
+
+template <typename Filter>
+vector<vector<Document>> FindAll(const SearchServer& search_server, const vector<string>& queries, Filter filter) {
+    vector<vector<Document>> result;
+    result.reserve(queries.size());
+    for (const string& query : queries) {
+        result.push_back(search_server.FindTopDocuments(query, filter));
+    }
+    return result;
+}
+
+bool AreSame(const vector<vector<Document>>& expected, const vector<vector<Document>>& actual) {
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (expected[i].size() != actual[i].size()) {
+            return false;
+        }
+        for (size_t j = 0; j < expected[i].size(); ++j) {
+            if (expected[i][j].id != actual[i][j].id || expected[i][j].relevance != actual[i][j].relevance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    mt19937 generator(42);
+
+    const vector<string> dictionary = GenerateDictionary(generator, 20'000, 10);
+    ZipfGenerator word_popularity(dictionary.size(), 1.0);
+
+    const vector<DocumentStatus> statuses = {DocumentStatus::ACTUAL, DocumentStatus::ACTUAL, DocumentStatus::ACTUAL,
+                                             DocumentStatus::IRRELEVANT, DocumentStatus::BANNED, DocumentStatus::REMOVED};
+
+    SearchServer search_server(dictionary[0]);
+    for (int id = 0; id < 20'000; ++id) {
+        const DocumentStatus status = statuses[uniform_int_distribution<size_t>(0, statuses.size() - 1)(generator)];
+        const int rating = uniform_int_distribution<int>(-5, 10)(generator);
+        search_server.AddDocument(id, GenerateText(generator, dictionary, word_popularity, 50), status, {rating});
+    }
+
+    vector<string> queries;
+    for (size_t i = 0; i < 500; ++i) {
+        const size_t word_count = uniform_int_distribution<size_t>(2, 6)(generator);
+        queries.push_back(GenerateText(generator, dictionary, word_popularity, word_count, 0.1));
+    }
+
+    // Single word queries with short posting lists, uniformly chosen words are mostly rare
+    vector<string> selective_queries;
+    for (size_t i = 0; i < 20'000; ++i) {
+        selective_queries.push_back(dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)]);
+    }
+
+    const auto status_generic = Measure("status, generic predicate"s, [&] {
+        return FindAll(search_server, queries, [](int document_id, DocumentStatus status, int rating) {
+            return status == DocumentStatus::ACTUAL;
+        });
+    });
+    const auto status_typed = Measure("status, StatusIs"s, [&] {
+        return FindAll(search_server, queries, StatusIs<DocumentStatus::ACTUAL>{});
+    });
+
+    const auto combined_generic = Measure("status and rating, generic predicate"s, [&] {
+        return FindAll(search_server, queries, [](int document_id, DocumentStatus status, int rating) {
+            return status == DocumentStatus::ACTUAL && rating >= 5;
+        });
+    });
+    const auto combined_typed = Measure("status and rating, AllOf"s, [&] {
+        return FindAll(search_server, queries, AllOf(StatusIs<DocumentStatus::ACTUAL>{}, RatingAtLeast{5}));
+    });
+
+    const auto selective_generic = Measure("selective queries, status and rating, generic predicate"s, [&] {
+        return FindAll(search_server, selective_queries, [](int document_id, DocumentStatus status, int rating) {
+            return status == DocumentStatus::ACTUAL && rating >= 5;
+        });
+    });
+    const auto selective_typed = Measure("selective queries, status and rating, AllOf"s, [&] {
+        return FindAll(search_server, selective_queries, AllOf(StatusIs<DocumentStatus::ACTUAL>{}, RatingAtLeast{5}));
+    });
+
+    if (!AreSame(status_generic, status_typed) || !AreSame(combined_generic, combined_typed)
+            || !AreSame(selective_generic, selective_typed)) {
+        cout << "Typed filters return different results"s << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "search_server.h"
+#include "process_queries.h"
+#include "benchmark_utils.h"
+
+using namespace std;
+
+// Synthetic replay of a query log: word and query popularity both follow Zipf's law,
+// so the batch contains repeated queries and frequent words shared by many queries
+
+int main() {
+    mt19937 generator(42);
+
+    const vector<string> dictionary = GenerateDictionary(generator, 20'000, 10);
+    ZipfGenerator word_popularity(dictionary.size(), 1.0);
+
+    SearchServer search_server(dictionary[0]);
+    for (int id = 0; id < 5'000; ++id) {
+        search_server.AddDocument(id, GenerateText(generator, dictionary, word_popularity, 50), DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+
+    vector<string> distinct_queries;
+    for (size_t i = 0; i < 1'000; ++i) {
+        const size_t word_count = uniform_int_distribution<size_t>(2, 6)(generator);
+        distinct_queries.push_back(GenerateText(generator, dictionary, word_popularity, word_count, 0.1));
+    }
+
+    ZipfGenerator query_popularity(distinct_queries.size(), 0.9);
+    vector<string> queries;
+    for (size_t i = 0; i < 3'000; ++i) {
+        queries.push_back(distinct_queries[query_popularity(generator)]);
+    }
+
+    const auto expected = Measure("ProcessQueries"s, [&] { return ProcessQueries(search_server, queries); });
+    const auto batched = Measure("ProcessQueriesBatched"s, [&] { return ProcessQueriesBatched(search_server, queries); });
+
+    for (size_t i = 0; i < queries.size(); ++i) {
+        bool same = expected[i].size() == batched[i].size();
+        for (size_t j = 0; same && j < expected[i].size(); ++j) {
+            same = expected[i][j].id == batched[i][j].id && expected[i][j].relevance == batched[i][j].relevance;
+        }
+        if (!same) {
+            cout << "Results differ for query \""s << queries[i] << "\""s << endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Synthetic data generators and timing helper shared by the benchmarks
+
+class ZipfGenerator {
+    public:
+        ZipfGenerator(size_t count, double exponent) {
+            std::vector<double> weights(count);
+            for (size_t i = 0; i < count; ++i) {
+                weights[i] = 1.0 / std::pow(i + 1, exponent);
+            }
+            distribution_ = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+        }
+
+        size_t operator()(std::mt19937& generator) {
+            return distribution_(generator);
+        }
+
+    private:
+        std::discrete_distribution<size_t> distribution_;
+};
+
+inline std::string GenerateWord(std::mt19937& generator, size_t max_length) {
+    const size_t length = std::uniform_int_distribution<size_t>(1, max_length)(generator);
+    std::string word;
+    for (size_t i = 0; i < length; ++i) {
+        word.push_back(std::uniform_int_distribution<int>('a', 'z')(generator));
+    }
+    return word;
+}
+
+inline std::vector<std::string> GenerateDictionary(std::mt19937& generator, size_t word_count, size_t max_length) {
+    std::vector<std::string> words;
+    words.reserve(word_count);
+    for (size_t i = 0; i < word_count; ++i) {
+        words.push_back(GenerateWord(generator, max_length));
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    std::shuffle(words.begin(), words.end(), generator);
+    return words;
+}
+
+inline std::string GenerateText(std::mt19937& generator, const std::vector<std::string>& dictionary, ZipfGenerator& word_popularity,
+                                size_t word_count, double minus_prob = 0) {
+    std::string text;
+    for (size_t i = 0; i < word_count; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        if (std::uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
+            text.push_back('-');
+        }
+        text += dictionary[word_popularity(generator)];
+    }
+    return text;
+}
+
+template <typename Function>
+auto Measure(const std::string& name, Function process) {
+    const auto start = std::chrono::steady_clock::now();
+    auto result = process();
+    const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << name << ": " << duration.count() << " ms" << std::endl;
+    return result;
+}
@@ -20,6 +20,12 @@ struct Document {
     Document(int id_p, double rel_p, int rating_p);
 }; 
 
+// Top documents of a query executed with QueryBudget
+struct SearchResult {
+    std::vector<Document> documents;
+    bool is_partial = false; // budget ran out, documents are the best ones found so far
+};
+
 void PrintMatchDocumentResult(int document_id, const std::vector<std::string>& words, DocumentStatus status);
 
 std::ostream& operator<<(std::ostream& output, Document  doc); // except PrintDocument
\ No newline at end of file
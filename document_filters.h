@@ -0,0 +1,41 @@
+#pragma once
+
+#include <tuple>
+
+#include "document.h"
+
+// Ready-made document filters for FindTopDocuments. They are ordinary predicates, and AllOf
+// combines them without a hand-written lambda.
+
+template <DocumentStatus Status>
+struct StatusIs {
+    bool operator()(int document_id, DocumentStatus status, int rating) const {
+        return status == Status;
+    }
+};
+
+struct RatingAtLeast {
+    int min_rating;
+
+    bool operator()(int document_id, DocumentStatus status, int rating) const {
+        return rating >= min_rating;
+    }
+};
+
+// Accepts documents accepted by all the filters, e.g. AllOf(StatusIs<DocumentStatus::ACTUAL>{}, RatingAtLeast{3})
+template <typename... Filters>
+class AllOf {
+    public:
+        explicit AllOf(Filters... filters)
+            : filters_(filters...) {
+        }
+
+        bool operator()(int document_id, DocumentStatus status, int rating) const {
+            return std::apply([&](const auto&... filters) {
+                return (filters(document_id, status, rating) && ...);
+            }, filters_);
+        }
+
+    private:
+        std::tuple<Filters...> filters_;
+};
@@ -15,6 +15,35 @@ std::vector<std::vector<Document>> ProcessQueries(
         return result;
     }
 
+std::vector<SearchResult> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    QueryBudget& budget) {
+        std::vector<SearchResult> result(queries.size()); 
+
+        std::transform(std::execution::par, 
+                        queries.begin(), queries.end(),
+                        result.begin(), 
+                        [&](const std::string& query){
+                            return search_server.FindTopDocuments(query, budget);
+                        });
+        
+        return result;
+    }
+
+std::vector<std::vector<Document>> ProcessQueriesBatched(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries) {
+        return search_server.FindTopDocumentsBatch(queries);
+    }
+
+std::vector<std::vector<Document>> ProcessQueriesBatched(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    const SearchServer::TaskRunner& run_tasks) {
+        return search_server.FindTopDocumentsBatch(queries, DocumentStatus::ACTUAL, run_tasks);
+    }
+
 std::list<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries){
@@ -10,6 +10,23 @@ std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
+// All queries share the budget, results of the queries interrupted by it are marked as partial
+std::vector<SearchResult> ProcessQueries(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    QueryBudget& budget);
+
+// Same result as ProcessQueries, but the batch is evaluated at once by SearchServer::FindTopDocumentsBatch
+std::vector<std::vector<Document>> ProcessQueriesBatched(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries);
+
+// Same as above, independent parts of the batch are run by run_tasks (e.g. on a caller's thread pool)
+std::vector<std::vector<Document>> ProcessQueriesBatched(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    const SearchServer::TaskRunner& run_tasks);
+
 std::list<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries); 
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "query_budget.h"
+
+QueryBudget::QueryBudget(Clock::time_point deadline)
+    : deadline_(deadline) {
+}
+
+QueryBudget::QueryBudget(size_t max_postings)
+    : limits_postings_(true)
+    , remaining_postings_(static_cast<int64_t>(max_postings)) {
+}
+
+QueryBudget::QueryBudget(Clock::time_point deadline, size_t max_postings)
+    : deadline_(deadline)
+    , limits_postings_(true)
+    , remaining_postings_(static_cast<int64_t>(max_postings)) {
+}
+
+bool QueryBudget::IsLimited() const {
+    return deadline_ || limits_postings_;
+}
+
+bool QueryBudget::IsExhausted() const {
+    return exhausted_.load(std::memory_order_relaxed);
+}
+
+bool QueryBudget::Consume(size_t postings) {
+    if (!IsLimited()) {
+        return true;
+    }
+    if (IsExhausted()) {
+        return false;
+    }
+
+    if ((limits_postings_ && remaining_postings_.fetch_sub(static_cast<int64_t>(postings), std::memory_order_relaxed) < static_cast<int64_t>(postings))
+            || (deadline_ && Clock::now() >= *deadline_)) {
+        exhausted_.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
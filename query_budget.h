@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+// Limits query execution by a deadline and/or by the number of scanned postings.
+// Queries check it cooperatively every CHECK_INTERVAL postings, one budget may be shared
+// by several queries running in parallel (e.g. the whole ProcessQueries batch).
+class QueryBudget {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        inline static constexpr size_t CHECK_INTERVAL = 64;
+
+        // Unlimited budget
+        QueryBudget() = default;
+
+        explicit QueryBudget(Clock::time_point deadline);
+
+        explicit QueryBudget(size_t max_postings);
+
+        QueryBudget(Clock::time_point deadline, size_t max_postings);
+
+        QueryBudget(const QueryBudget&) = delete;
+        QueryBudget& operator=(const QueryBudget&) = delete;
+
+        bool IsLimited() const;
+
+        bool IsExhausted() const;
+
+        // Accounts scanned postings, returns false once more postings are scanned than the budget allows
+        // or the deadline has passed
+        bool Consume(size_t postings);
+
+    private:
+        std::optional<Clock::time_point> deadline_;
+        bool limits_postings_ = false;
+        std::atomic<int64_t> remaining_postings_ = 0;
+        std::atomic<bool> exhausted_ = false;
+};
@@ -0,0 +1,510 @@
+#include "query_server.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "process_queries.h"
+
+using namespace std::literals;
+
+namespace {
+
+std::runtime_error SystemError(const std::string& what) {
+    return std::runtime_error(what + ": "s + std::strerror(errno));
+}
+
+std::string_view TakeToken(std::string_view& text) {
+    text.remove_prefix(std::min(text.find_first_not_of(' '), text.size()));
+    const size_t space = std::min(text.find(' '), text.size());
+    std::string_view token = text.substr(0, space);
+    text.remove_prefix(space);
+    return token;
+}
+
+int ParseNumber(std::string_view token) {
+    int value = 0;
+    const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (token.empty() || error != std::errc() || end != token.data() + token.size()) {
+        throw std::invalid_argument("Invalid number: "s + std::string(token));
+    }
+    return value;
+}
+
+} // namespace
+
+QueryServer::QueryServer(SearchServer& search_server, uint16_t port, size_t worker_count)
+    : search_server_(search_server)
+    , worker_count_(std::max<size_t>(worker_count, 1)) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw SystemError("Can't create socket"s);
+    }
+
+    const int enable = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(listen_fd_);
+        throw SystemError("Can't bind to port "s + std::to_string(port));
+    }
+    if (listen(listen_fd_, SOMAXCONN) < 0) {
+        close(listen_fd_);
+        throw SystemError("Can't listen"s);
+    }
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || event_fd_ < 0) {
+        close(listen_fd_);
+        throw SystemError("Can't create epoll"s);
+    }
+
+    for (int fd : {listen_fd_, event_fd_}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+QueryServer::~QueryServer() {
+    for (const auto& [fd, connection] : connections_) {
+        close(fd);
+    }
+    close(event_fd_);
+    close(epoll_fd_);
+    close(listen_fd_);
+}
+
+void QueryServer::Run() {
+    for (size_t i = 0; i < worker_count_; ++i) {
+        workers_.emplace_back([this] { ServeWorkers(); });
+    }
+    dispatcher_ = std::thread([this] { DispatchRequests(); });
+
+    try {
+        ServeConnections();
+    } catch (...) {
+        StopThreads();
+        throw;
+    }
+    StopThreads();
+}
+
+void QueryServer::ServeConnections() {
+    const int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+
+    while (!stopping_) {
+        const int events_count = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+        if (events_count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw SystemError("epoll_wait failed"s);
+        }
+
+        for (int i = 0; i < events_count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                AcceptConnections();
+            } else if (fd == event_fd_) {
+                uint64_t counter;
+                while (read(event_fd_, &counter, sizeof(counter)) > 0) {
+                }
+                FlushAllConnections();
+            } else {
+                // Connection may be already closed by a previous event of the same batch
+                auto it = connections_.find(fd);
+                if (it == connections_.end()) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                    ReadFromConnection(fd, it->second);
+                    it = connections_.find(fd);
+                }
+                if (it != connections_.end() && (events[i].events & EPOLLOUT)) {
+                    FlushConnection(fd, it->second);
+                }
+            }
+        }
+    }
+}
+
+void QueryServer::StopThreads() {
+    {
+        std::lock_guard guard(requests_mutex_);
+        dispatcher_stopping_ = true;
+    }
+    requests_cv_.notify_all();
+    dispatcher_.join();
+
+    {
+        std::lock_guard guard(tasks_mutex_);
+        workers_stopping_ = true;
+    }
+    tasks_cv_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+void QueryServer::Stop() {
+    stopping_ = true;
+    WakeUp();
+}
+
+void QueryServer::AcceptConnections() {
+    for (;;) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+        connections_[fd];
+    }
+}
+
+void QueryServer::ReadFromConnection(int fd, Connection& connection) {
+    char buffer[64 * 1024];
+    std::vector<Request> requests;
+    // Stops reading once the client falls behind, the rest of its requests waits in the socket buffer
+    while (!connection.peer_closed && !IsBackedUp(connection)) {
+        const ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+        if (size > 0) {
+            connection.input.append(buffer, size);
+            ParseRequests(connection, requests);
+            if (connection.input.size() > MAX_LINE_SIZE) {
+                CloseConnection(fd);
+                return;
+            }
+            continue;
+        }
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (size < 0 && errno == EINTR) {
+            continue;
+        }
+        if (size < 0) {
+            CloseConnection(fd);
+            return;
+        }
+        connection.peer_closed = true;
+    }
+
+    if (!requests.empty()) {
+        {
+            std::lock_guard guard(requests_mutex_);
+            std::move(requests.begin(), requests.end(), std::back_inserter(requests_));
+        }
+        requests_cv_.notify_one();
+    }
+
+    if (connection.peer_closed) {
+        FlushConnection(fd, connection);
+    } else {
+        UpdateEvents(fd, connection);
+    }
+}
+
+void QueryServer::ParseRequests(Connection& connection, std::vector<Request>& requests) {
+    size_t line_begin = 0;
+    for (size_t line_end = connection.input.find('\n'); line_end != std::string::npos;
+            line_end = connection.input.find('\n', line_begin)) {
+        std::string line = connection.input.substr(line_begin, line_end - line_begin);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        line_begin = line_end + 1;
+
+        auto response = std::make_shared<Response>();
+        connection.responses.push_back(response);
+        requests.push_back({std::move(line), std::move(response)});
+    }
+    connection.input.erase(0, line_begin);
+}
+
+void QueryServer::FlushConnection(int fd, Connection& connection) {
+    while (!connection.responses.empty() && connection.responses.front()->ready.load(std::memory_order_acquire)) {
+        connection.output += connection.responses.front()->text;
+        connection.output += '\n';
+        connection.responses.pop_front();
+    }
+
+    size_t sent = 0;
+    while (sent < connection.output.size()) {
+        const ssize_t size = send(fd, connection.output.data() + sent, connection.output.size() - sent, MSG_NOSIGNAL);
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            CloseConnection(fd);
+            return;
+        }
+        sent += size;
+    }
+    connection.output.erase(0, sent);
+
+    if (connection.peer_closed && connection.responses.empty() && connection.output.empty()) {
+        CloseConnection(fd);
+        return;
+    }
+
+    UpdateEvents(fd, connection);
+}
+
+void QueryServer::FlushAllConnections() {
+    std::vector<int> fds;
+    for (const auto& [fd, connection] : connections_) {
+        fds.push_back(fd);
+    }
+    for (int fd : fds) {
+        if (auto it = connections_.find(fd); it != connections_.end()) {
+            FlushConnection(fd, it->second);
+        }
+    }
+}
+
+void QueryServer::UpdateEvents(int fd, Connection& connection) {
+    // Waits for the socket to become writable only while there is something left to send,
+    // reading is resumed once the client has read enough of the pending responses
+    const uint32_t events = (connection.peer_closed || IsBackedUp(connection) ? 0 : EPOLLIN)
+                            | (connection.output.empty() ? 0 : EPOLLOUT);
+    if (events != connection.events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event);
+        connection.events = events;
+    }
+}
+
+void QueryServer::CloseConnection(int fd) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.erase(fd);
+}
+
+void QueryServer::WakeUp() {
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t size = write(event_fd_, &one, sizeof(one));
+}
+
+void QueryServer::DispatchRequests() {
+    for (;;) {
+        std::vector<Request> batch;
+        {
+            std::unique_lock lock(requests_mutex_);
+            requests_cv_.wait(lock, [this] { return !requests_.empty() || dispatcher_stopping_; });
+            if (dispatcher_stopping_) {
+                return;
+            }
+            const size_t batch_size = std::min(requests_.size(), MAX_BATCH_SIZE);
+            std::move(requests_.begin(), requests_.begin() + batch_size, std::back_inserter(batch));
+            requests_.erase(requests_.begin(), requests_.begin() + batch_size);
+        }
+
+        std::vector<Request*> read_requests;
+        for (Request& request : batch) {
+            if (IsWriteRequest(request.line)) {
+                ServeReadRequests(read_requests);
+                read_requests.clear();
+
+                request.response->text = ExecuteRequest(request.line);
+                request.response->ready.store(true, std::memory_order_release);
+            } else {
+                read_requests.push_back(&request);
+            }
+        }
+        ServeReadRequests(read_requests);
+
+        WakeUp();
+    }
+}
+
+void QueryServer::ServeReadRequests(std::vector<Request*>& requests) {
+    if (requests.empty()) {
+        return;
+    }
+
+    std::vector<Request*> find_requests;
+    std::vector<std::string> queries;
+    std::vector<std::function<void()>> tasks;
+    for (Request* request : requests) {
+        std::string_view arguments = request->line;
+        if (TakeToken(arguments) == "FIND"sv) {
+            find_requests.push_back(request);
+            queries.emplace_back(arguments);
+        } else {
+            tasks.push_back([this, request] { request->response->text = ExecuteRequest(request->line); });
+        }
+    }
+
+    // All FIND queries of the batch are evaluated at once, so identical queries and shared words are processed once
+    try {
+        const std::vector<std::vector<Document>> results = ProcessQueriesBatched(search_server_, queries, 
+            [this](std::vector<std::function<void()>>& batch_tasks) { RunTasks(batch_tasks); });
+        for (size_t i = 0; i < find_requests.size(); ++i) {
+            find_requests[i]->response->text = FormatDocuments(results[i]);
+        }
+    } catch (const std::exception&) {
+        // Some query is invalid, evaluates them one by one to report the error to its sender only
+        for (Request* request : find_requests) {
+            tasks.push_back([this, request] { request->response->text = ExecuteRequest(request->line); });
+        }
+    }
+    RunTasks(tasks);
+
+    for (Request* request : requests) {
+        request->response->ready.store(true, std::memory_order_release);
+    }
+}
+
+void QueryServer::RunTasks(std::vector<std::function<void()>>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard guard(tasks_mutex_);
+        std::move(tasks.begin(), tasks.end(), std::back_inserter(tasks_));
+        unfinished_tasks_ += tasks.size();
+    }
+    tasks_cv_.notify_all();
+
+    std::unique_lock lock(tasks_mutex_);
+    tasks_done_cv_.wait(lock, [this] { return unfinished_tasks_ == 0; });
+}
+
+void QueryServer::ServeWorkers() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(tasks_mutex_);
+            tasks_cv_.wait(lock, [this] { return !tasks_.empty() || workers_stopping_; });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        task();
+
+        std::lock_guard guard(tasks_mutex_);
+        if (--unfinished_tasks_ == 0) {
+            tasks_done_cv_.notify_all();
+        }
+    }
+}
+
+std::string QueryServer::ExecuteRequest(const std::string& line) {
+    try {
+        std::string_view arguments = line;
+        const std::string_view command = TakeToken(arguments);
+        if (command == "FIND"sv) {
+            return ExecuteFind(arguments);
+        }
+        if (command == "MATCH"sv) {
+            return ExecuteMatch(arguments);
+        }
+        if (command == "ADD"sv) {
+            return ExecuteAdd(arguments);
+        }
+        if (command == "REMOVE"sv) {
+            return ExecuteRemove(arguments);
+        }
+        return "ERR Unknown command"s;
+    } catch (const std::exception& e) {
+        return "ERR "s + e.what();
+    }
+}
+
+std::string QueryServer::ExecuteFind(std::string_view query) const {
+    return FormatDocuments(search_server_.FindTopDocuments(query));
+}
+
+std::string QueryServer::ExecuteMatch(std::string_view arguments) const {
+    const int document_id = ParseNumber(TakeToken(arguments));
+    const auto [words, status] = search_server_.MatchDocument(arguments, document_id);
+
+    std::string result = "OK "s + std::to_string(static_cast<int>(status));
+    for (std::string_view word : words) {
+        result += ' ';
+        result += word;
+    }
+    return result;
+}
+
+std::string QueryServer::ExecuteAdd(std::string_view arguments) {
+    const int document_id = ParseNumber(TakeToken(arguments));
+
+    const int status = ParseNumber(TakeToken(arguments));
+    if (status < static_cast<int>(DocumentStatus::ACTUAL) || status > static_cast<int>(DocumentStatus::REMOVED)) {
+        throw std::invalid_argument("Invalid document status"s);
+    }
+
+    std::vector<int> ratings;
+    std::string_view ratings_list = TakeToken(arguments);
+    if (ratings_list != "-"sv) {
+        while (!ratings_list.empty()) {
+            const size_t comma = std::min(ratings_list.find(','), ratings_list.size());
+            ratings.push_back(ParseNumber(ratings_list.substr(0, comma)));
+            ratings_list.remove_prefix(std::min(comma + 1, ratings_list.size()));
+        }
+    }
+
+    search_server_.AddDocument(document_id, arguments, static_cast<DocumentStatus>(status), ratings);
+    return "OK"s;
+}
+
+std::string QueryServer::ExecuteRemove(std::string_view arguments) {
+    search_server_.RemoveDocument(ParseNumber(TakeToken(arguments)));
+    return "OK"s;
+}
+
+std::string QueryServer::FormatDocuments(const std::vector<Document>& documents) {
+    std::ostringstream result;
+    result << "OK"s;
+    for (const Document& document : documents) {
+        result << ' ' << document.id << ':' << document.relevance << ':' << document.rating;
+    }
+    return result.str();
+}
+
+bool QueryServer::IsWriteRequest(std::string_view line) {
+    const std::string_view command = TakeToken(line);
+    return command == "ADD"sv || command == "REMOVE"sv;
+}
+
+bool QueryServer::IsBackedUp(const Connection& connection) {
+    return connection.responses.size() >= MAX_PENDING_RESPONSES || connection.output.size() >= MAX_PENDING_OUTPUT;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <sys/epoll.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+// Local TCP front end for SearchServer with a line-delimited protocol. Every request and every
+// response is a single line, responses come in request order, so clients may pipeline requests:
+//   FIND <query>                                  -> OK <id>:<relevance>:<rating> ...
+//   MATCH <document id> <query>                   -> OK <status> <word> ...
+//   ADD <document id> <status> <ratings> <text>   -> OK   (status is a number, ratings are comma separated or -)
+//   REMOVE <document id>                          -> OK
+// Errors are reported as "ERR <message>".
+//
+// Requests received from all connections while the previous batch was served form the next batch.
+// FIND queries of a batch are evaluated together by ProcessQueriesBatched, its independent parts and
+// MATCH requests run on a fixed worker pool, ADD and REMOVE split the batch and run exclusively in arrival order.
+// A connection is not read while too many of its responses are pending, until the client reads them.
+class QueryServer {
+    public:
+        QueryServer(SearchServer& search_server, uint16_t port, size_t worker_count);
+
+        QueryServer(const QueryServer&) = delete;
+        QueryServer& operator=(const QueryServer&) = delete;
+
+        ~QueryServer();
+
+        // Serves connections until Stop is called
+        void Run();
+
+        // Safe to call from another thread or from a signal handler
+        void Stop();
+
+    private:
+        inline static constexpr size_t MAX_BATCH_SIZE = 1024;
+        inline static constexpr size_t MAX_LINE_SIZE = 64 * 1024;
+        // Backpressure thresholds of a connection
+        inline static constexpr size_t MAX_PENDING_RESPONSES = 1024;
+        inline static constexpr size_t MAX_PENDING_OUTPUT = 1024 * 1024;
+
+        struct Response {
+            std::string text;
+            std::atomic<bool> ready = false;
+        };
+
+        struct Request {
+            std::string line;
+            std::shared_ptr<Response> response;
+        };
+
+        struct Connection {
+            std::string input;
+            std::string output;
+            std::deque<std::shared_ptr<Response>> responses; // in request order
+            uint32_t events = EPOLLIN; // events the connection is registered for in epoll
+            bool peer_closed = false; // no more requests, connection is closed once all responses are sent
+        };
+
+        SearchServer& search_server_;
+        size_t worker_count_;
+
+        int listen_fd_ = -1;
+        int epoll_fd_ = -1;
+        int event_fd_ = -1; // wakes up the network loop when responses are ready or server stops
+
+        std::atomic<bool> stopping_ = false;
+
+        std::map<int, Connection> connections_;
+
+        std::mutex requests_mutex_;
+        std::condition_variable requests_cv_;
+        std::deque<Request> requests_;
+        bool dispatcher_stopping_ = false;
+
+        std::mutex tasks_mutex_;
+        std::condition_variable tasks_cv_;
+        std::condition_variable tasks_done_cv_;
+        std::deque<std::function<void()>> tasks_;
+        size_t unfinished_tasks_ = 0;
+        bool workers_stopping_ = false;
+
+        std::thread dispatcher_;
+        std::vector<std::thread> workers_;
+
+        void ServeConnections();
+        void StopThreads();
+
+        void AcceptConnections();
+        void ReadFromConnection(int fd, Connection& connection);
+        void FlushConnection(int fd, Connection& connection);
+        void FlushAllConnections();
+        void UpdateEvents(int fd, Connection& connection);
+        void CloseConnection(int fd);
+        void WakeUp();
+
+        void DispatchRequests();
+        void ServeReadRequests(std::vector<Request*>& requests);
+        // Runs the tasks on the worker pool and waits for all of them, tasks must not throw
+        void RunTasks(std::vector<std::function<void()>>& tasks);
+        void ServeWorkers();
+
+        std::string ExecuteRequest(const std::string& line);
+        std::string ExecuteFind(std::string_view query) const;
+        std::string ExecuteMatch(std::string_view arguments) const;
+        std::string ExecuteAdd(std::string_view arguments);
+        std::string ExecuteRemove(std::string_view arguments);
+
+        static std::string FormatDocuments(const std::vector<Document>& documents);
+        static bool IsWriteRequest(std::string_view line);
+        static bool IsBackedUp(const Connection& connection);
+        static void ParseRequests(Connection& connection, std::vector<Request>& requests);
+};
@@ -27,15 +27,42 @@ void SearchServer::AddDocument(int document_id, std::string_view document, Docum
 
     storage_.emplace_back(document);
 
-    const std::vector<std::string_view>& document_words = SplitIntoWordsNoStop(storage_.back());              
-    for (std::string_view word : document_words) {
-        double word_TF = 1.0 / document_words.size();
-        word_to_document_index_[word][document_id] += word_TF;
-        document_to_word_index_[document_id][word] += word_TF;
-    }     
+    // Everything that may fail is done before the index is changed, a failed insertion is rolled back
+    std::vector<TermDictionary::TermId> inserted_terms;
+    try {
+        const std::vector<std::string_view>& document_words = SplitIntoWordsNoStop(storage_.back());              
+        std::map<std::string_view, double> word_frequencies;
+        for (std::string_view word : document_words) {
+            double word_TF = 1.0 / document_words.size();
+            word_frequencies[word] += word_TF;
+        }
+        const DocumentData document_info = {ComputeAverageRating(ratings), status};
+
+        // New words get the next term ids, so the postings are allocated before the words are added to the dictionary
+        if (word_to_document_index_.size() < terms_.size() + word_frequencies.size()) {
+            word_to_document_index_.resize(terms_.size() + word_frequencies.size());
+        }
+        inserted_terms.reserve(word_frequencies.size());
 
-    documents_id_.insert(document_id);
-    documents_[document_id] = {ComputeAverageRating(ratings), status};   
+        for (const auto& [word, word_TF] : word_frequencies) {
+            TermDictionary::TermId term = terms_.Insert(word);
+            word_to_document_index_[term].emplace(document_id, Posting{word_TF, document_info.rating, document_info.status});
+            inserted_terms.push_back(term);
+        }
+
+        documents_id_.insert(document_id);
+        documents_.emplace(document_id, document_info);
+        document_to_word_index_.emplace(document_id, std::move(word_frequencies));
+    } catch (...) {
+        // Words stay in the dictionary, terms without postings are ignored by queries
+        for (TermDictionary::TermId term : inserted_terms) {
+            word_to_document_index_[term].erase(document_id);
+        }
+        documents_id_.erase(document_id);
+        documents_.erase(document_id);
+        storage_.pop_back();
+        throw;
+    }
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
@@ -43,7 +70,147 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus search_status) const {
-    return FindTopDocuments(raw_query, [search_status](int document_id, DocumentStatus status, int rating) { return status == search_status; });
+    QueryBudget unlimited_budget;
+    return FindTopDocuments(raw_query, search_status, unlimited_budget).documents;
+}
+
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, QueryBudget& budget) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL, budget);
+}
+
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus search_status, QueryBudget& budget) const {
+    return FindTopDocuments(raw_query, [search_status](int document_id, DocumentStatus status, int rating) { return status == search_status; }, budget);
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries) const {
+    return FindTopDocumentsBatch(raw_queries, DocumentStatus::ACTUAL);
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries, 
+                                                                        DocumentStatus search_status) const {
+    return FindTopDocumentsBatch(raw_queries, search_status, [](std::vector<std::function<void()>>& tasks) {
+        std::for_each(std::execution::par, tasks.begin(), tasks.end(), [](const std::function<void()>& task) { task(); });
+    });
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries, 
+                                                                        DocumentStatus search_status, const TaskRunner& run_tasks) const {
+    using Terms = std::vector<TermDictionary::TermId>;
+
+    // Queries resolving to the same plus and minus terms are evaluated once
+    std::map<std::pair<Terms, Terms>, size_t> unique_index;
+    std::vector<const std::pair<Terms, Terms>*> unique_queries;
+    std::vector<size_t> query_to_unique(raw_queries.size());
+
+    for (size_t i = 0; i < raw_queries.size(); ++i) {
+        Query parsed_query = ParseQuery(raw_queries[i], true);
+        auto [it, inserted] = unique_index.emplace(
+            std::pair(ResolveTerms(parsed_query.plus_words, parsed_query.plus_prefixes, MAX_PREFIX_EXPANSION_COUNT), 
+                      ResolveTerms(parsed_query.minus_words, parsed_query.minus_prefixes, NO_EXPANSION_LIMIT)), 
+            unique_queries.size());
+        if (inserted) {
+            unique_queries.push_back(&it->first);
+        }
+        query_to_unique[i] = it->second;
+    }
+
+    std::map<TermDictionary::TermId, std::vector<size_t>> plus_term_queries;
+    std::map<TermDictionary::TermId, std::vector<size_t>> minus_term_queries;
+    for (size_t query = 0; query < unique_queries.size(); ++query) {
+        for (TermDictionary::TermId term : unique_queries[query]->first) {
+            plus_term_queries[term].push_back(query);
+        }
+        for (TermDictionary::TermId term : unique_queries[query]->second) {
+            minus_term_queries[term].push_back(query);
+        }
+    }
+
+    // Document ids are split into shards of equal document count, every shard scans its part
+    // of the posting lists for all queries of the batch
+    const size_t shard_count = std::clamp<size_t>(documents_id_.size() / MIN_BATCH_SHARD_SIZE, 1, MAX_BATCH_SHARD_COUNT);
+    std::vector<int> shard_begins; // first document id of every shard
+    size_t document_index = 0;
+    for (int document_id : documents_id_) {
+        if (document_index++ * shard_count / documents_id_.size() == shard_begins.size()) {
+            shard_begins.push_back(document_id);
+        }
+    }
+
+    // shard : query : documents of the shard matching the query, in ascending id order
+    std::vector<std::vector<std::vector<Document>>> shard_documents(shard_begins.size());
+
+    std::vector<std::function<void()>> tasks;
+    for (size_t shard = 0; shard < shard_begins.size(); ++shard) {
+        tasks.push_back([&, shard] {
+            auto get_shard_postings = [&](TermDictionary::TermId term) {
+                const std::map<int, Posting>& postings = word_to_document_index_[term];
+                return std::pair(postings.lower_bound(shard_begins[shard]), 
+                                 shard + 1 < shard_begins.size() ? postings.lower_bound(shard_begins[shard + 1]) : postings.end());
+            };
+
+            std::vector<std::map<int, double>> matched_documents(unique_queries.size()); // query : [id, relevance]
+
+            // Terms are visited in ascending order, as in FindAllDocuments, so relevances are summed identically
+            for (const auto& [term, term_queries] : plus_term_queries) {
+                if (word_to_document_index_[term].empty()) {
+                    continue;
+                }
+                double word_IDF = ComputeWordIDF(term);
+                const auto [begin, end] = get_shard_postings(term);
+                for (auto it = begin; it != end; ++it) {
+                    const auto& [id, posting] = *it;
+                    if (posting.status != search_status) {
+                        continue;
+                    }
+                    for (size_t query : term_queries) {
+                        matched_documents[query][id] += posting.term_frequency * word_IDF;
+                    }
+                }
+            }
+
+            for (const auto& [term, term_queries] : minus_term_queries) {
+                const auto [begin, end] = get_shard_postings(term);
+                for (auto it = begin; it != end; ++it) {
+                    for (size_t query : term_queries) {
+                        matched_documents[query].erase(it->first);
+                    }
+                }
+            }
+
+            std::vector<std::vector<Document>>& documents = shard_documents[shard];
+            documents.resize(unique_queries.size());
+            for (size_t query = 0; query < unique_queries.size(); ++query) {
+                for (const auto& [id, relevance] : matched_documents[query]) {
+                    documents[query].push_back({id, relevance, documents_.at(id).rating});
+                }
+            }
+        });
+    }
+    run_tasks(tasks);
+
+    // Shards are concatenated in id order, so every query sorts exactly the documents FindTopDocuments sorts
+    std::vector<std::vector<Document>> unique_results(unique_queries.size());
+    const size_t chunk_size = unique_queries.size() / shard_count + 1;
+    tasks.clear();
+    for (size_t begin = 0; begin < unique_queries.size(); begin += chunk_size) {
+        tasks.push_back([&, begin] {
+            for (size_t query = begin; query < std::min(begin + chunk_size, unique_queries.size()); ++query) {
+                std::vector<Document>& top_documents = unique_results[query];
+                for (const std::vector<std::vector<Document>>& documents : shard_documents) {
+                    top_documents.insert(top_documents.end(), documents[query].begin(), documents[query].end());
+                }
+                SortTopDocuments(top_documents);
+            }
+        });
+    }
+    run_tasks(tasks);
+
+    std::vector<std::vector<Document>> result(raw_queries.size());
+    for (size_t i = 0; i < raw_queries.size(); ++i) {
+        result[i] = unique_results[query_to_unique[i]];
+    }
+
+    return result;
 }
 
 int SearchServer::GetDocumentCount() const {
@@ -55,18 +222,32 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 
     std::vector<std::string_view> matched_words; 
 
+    const std::map<std::string_view, double>& document_words = GetWordFrequencies(document_id);
+
     for (const std::string_view word : parsed_query.minus_words) {
-        if (word_to_document_index_.count(word) && word_to_document_index_.at(word).count(document_id)) {
+        if (document_words.count(word)) {
+            return std::tuple(matched_words, documents_.at(document_id).status);
+        }
+    }
+
+    for (const std::string_view prefix : parsed_query.minus_prefixes) {
+        if (HasWordWithPrefix(document_words, prefix)) {
             return std::tuple(matched_words, documents_.at(document_id).status);
         }
     }
 
     for (const std::string_view word : parsed_query.plus_words) {
-        if (word_to_document_index_.count(word) && word_to_document_index_.at(word).count(document_id)) {
+        if (document_words.count(word)) {
             matched_words.push_back(word);
         }
     }
 
+    if (!parsed_query.plus_prefixes.empty()) {
+        CollectWordsWithPrefixes(document_words, parsed_query.plus_prefixes, matched_words);
+        std::sort(matched_words.begin(), matched_words.end());
+        matched_words.erase(std::unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    }
+
     return std::tuple(matched_words, documents_.at(document_id).status);
 }
 
@@ -93,6 +274,12 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     {
         return std::tuple(matched_words, documents_.at(document_id).status);
     }
+
+    for (const std::string_view prefix : parsed_query.minus_prefixes) {
+        if (HasWordWithPrefix(document_to_word_index_.at(document_id), prefix)) {
+            return std::tuple(matched_words, documents_.at(document_id).status);
+        }
+    }
     
     matched_words.resize(parsed_query.plus_words.size());
 
@@ -101,8 +288,14 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
                                     return document_to_word_index_.at(document_id).count(p_word) == 1;
                                 });
     
-    std::sort(policy, matched_words.begin(), end_it);
-    matched_words.erase(std::unique(matched_words.begin(), end_it), matched_words.end());
+    matched_words.erase(end_it, matched_words.end());
+
+    if (!parsed_query.plus_prefixes.empty()) {
+        CollectWordsWithPrefixes(document_to_word_index_.at(document_id), parsed_query.plus_prefixes, matched_words);
+    }
+    
+    std::sort(policy, matched_words.begin(), matched_words.end());
+    matched_words.erase(std::unique(matched_words.begin(), matched_words.end()), matched_words.end());
 
     return std::tuple(matched_words, documents_.at(document_id).status); 
 }
@@ -129,6 +322,16 @@ std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_vie
     return words;
 }
 
+bool SearchServer::IsPrefixWord(std::string_view word) {
+    if (word.back() != '*') {
+        return false;
+    }
+    if (word.size() == 1) {
+        throw std::invalid_argument("Prefix word should contain at least one symbol before '*'");
+    }
+    return true;
+}
+
 SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool do_sort) const {
     Query query_words;
     for (std::string_view word : SplitIntoWordsNoStop(text)) {
@@ -142,9 +345,14 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool do_sort
             std::string_view tmp = word.substr(1);
             if (stop_words_.count(tmp))
                 continue;
+            else if (IsPrefixWord(tmp))
+                query_words.minus_prefixes.push_back(tmp.substr(0, tmp.size() - 1));
             else 
                 query_words.minus_words.push_back(tmp);
         } 
+        else if (IsPrefixWord(word)) {
+            query_words.plus_prefixes.push_back(word.substr(0, word.size() - 1));
+        }
         else {
             query_words.plus_words.push_back(word);
         }        
@@ -163,6 +371,20 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool do_sort
     return query_words;
 }
 
+void SearchServer::SortTopDocuments(std::vector<Document>& documents) {
+    const double EPSILON = 1e-6;
+
+    sort(documents.begin(), documents.end(), 
+        [EPSILON](const Document& el1, const Document& el2){
+            return el1.relevance > el2.relevance || 
+            (std::abs(el1.relevance - el2.relevance) < EPSILON && el1.rating > el2.rating) ;
+        });             
+
+    if ( documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+        documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+}
+
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     if (ratings.empty())
         return 0;
@@ -170,8 +392,69 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return (std::accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size()));
 }
 
-double SearchServer::ComputeWordIDF(std::string_view word) const {
-    return std::log((1.0 * documents_.size() )/ word_to_document_index_.at(word).size());
+double SearchServer::ComputeWordIDF(TermDictionary::TermId term) const {
+    return std::log((1.0 * documents_.size() )/ word_to_document_index_[term].size());
+}
+
+std::vector<TermDictionary::TermId> SearchServer::ResolveTerms(const std::vector<std::string_view>& words, 
+                                                                const std::vector<std::string_view>& prefixes,
+                                                                size_t max_expansion_count) const {
+    std::vector<TermDictionary::TermId> terms;
+
+    for (std::string_view word : words) {
+        TermDictionary::TermId term = terms_.Find(word);
+        if (term != TermDictionary::NO_TERM) {
+            terms.push_back(term);
+        }
+    }
+
+    for (std::string_view prefix : prefixes) {
+        // Terms of removed documents stay in the dictionary, only the terms with postings take expansion slots
+        const auto has_postings = [this](TermDictionary::TermId term) { return !word_to_document_index_[term].empty(); };
+        for (TermDictionary::TermId term : terms_.FindByPrefix(prefix, max_expansion_count, has_postings)) {
+            terms.push_back(term);
+        }
+    }
+
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+    return terms;
+}
+
+void SearchServer::ExcludeDocuments(std::map<int, double>& matched_documents, const std::vector<TermDictionary::TermId>& minus_terms) const {
+    for (TermDictionary::TermId term : minus_terms) {
+        const std::map<int, Posting>& postings = word_to_document_index_[term];
+        // Probing postings of every matched document is cheaper than scanning long posting lists of frequent words
+        if (matched_documents.size() < postings.size()) {
+            for (auto it = matched_documents.begin(); it != matched_documents.end(); ) {
+                it = postings.count(it->first) ? matched_documents.erase(it) : std::next(it);
+            }
+        } else {
+            for (const auto& [id, posting] : postings) {
+                matched_documents.erase(id);
+            }
+        }
+    }
+}
+
+bool SearchServer::HasWordWithPrefix(const std::map<std::string_view, double>& document_words, std::string_view prefix) {
+    auto it = document_words.lower_bound(prefix);
+    return it != document_words.end() && it->first.substr(0, prefix.size()) == prefix;
+}
+
+void SearchServer::CollectWordsWithPrefixes(const std::map<std::string_view, double>& document_words, 
+                                            const std::vector<std::string_view>& prefixes, std::vector<std::string_view>& words) const {
+    const std::vector<TermDictionary::TermId> expanded_terms = ResolveTerms({}, prefixes, MAX_PREFIX_EXPANSION_COUNT);
+
+    for (const std::string_view prefix : prefixes) {
+        for (auto it = document_words.lower_bound(prefix); 
+                it != document_words.end() && it->first.substr(0, prefix.size()) == prefix; ++it) {
+            if (std::binary_search(expanded_terms.begin(), expanded_terms.end(), terms_.Find(it->first))) {
+                words.push_back(it->first);
+            }
+        }
+    }
 }
 
 const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
@@ -189,7 +472,7 @@ void SearchServer::RemoveDocument(int document_id) {
         documents_.erase(document_id);
 
         for (const auto& [word, word_TF] : document_to_word_index_.at(document_id)) {
-            word_to_document_index_.at(word).erase(document_id);
+            word_to_document_index_[terms_.Find(word)].erase(document_id);
         }
 
         document_to_word_index_.erase(document_id);
@@ -211,7 +494,7 @@ void SearchServer::RemoveDocument(std::execution::parallel_policy policy, int do
                         [](auto& var){return var.first;});
 
         std::for_each(policy, vec_ptr.begin(), vec_ptr.end(), [&](auto word) {
-            word_to_document_index_.at(word).erase(document_id);
+            word_to_document_index_[terms_.Find(word)].erase(document_id);
         });
 
         documents_.erase(document_id);
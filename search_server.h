@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include <stdexcept>
 #include <tuple>
 #include <set>
@@ -11,12 +12,21 @@
 #include <execution>
 #include <vector>
 #include <deque>
+#include <functional>
 
 #include "string_processing.h"
 #include "document.h"
+#include "term_dictionary.h"
+#include "query_budget.h"
+#include "document_filters.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 
+// Maximum number of index terms a single plus prefix word (e.g. "pet*") is expanded to.
+// Minus prefix words are expanded without a limit, so every document containing an excluded word is excluded
+const size_t MAX_PREFIX_EXPANSION_COUNT = 64;
+const size_t NO_EXPANSION_LIMIT = SIZE_MAX;
+
 class SearchServer {
     public:
         explicit SearchServer(const std::string& stop_words_set)
@@ -48,6 +58,28 @@ class SearchServer {
         template <typename Function>
         std::vector<Document> FindTopDocuments(std::string_view raw_query, Function FilterDocument) const;
 
+        // Stops scanning postings once the budget is exhausted and returns the best documents found so far
+        SearchResult FindTopDocuments(std::string_view raw_query, QueryBudget& budget) const;
+
+        SearchResult FindTopDocuments(std::string_view raw_query, DocumentStatus search_status, QueryBudget& budget) const;
+
+        template <typename Function>
+        SearchResult FindTopDocuments(std::string_view raw_query, Function FilterDocument, QueryBudget& budget) const;
+
+        // Finds top documents for every query of the batch at once: identical queries are evaluated once,
+        // posting list of every word is scanned once for all queries containing it
+        std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries) const;
+
+        std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries, DocumentStatus search_status) const;
+
+        // Runs all the tasks, possibly in parallel, and returns once every one of them is finished
+        using TaskRunner = std::function<void(std::vector<std::function<void()>>& tasks)>;
+
+        // Parts of the batch (document id shards, then result merging) are evaluated as tasks of run_tasks
+        // instead of std::execution::par
+        std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string>& raw_queries, DocumentStatus search_status, 
+                                                                const TaskRunner& run_tasks) const;
+
         int GetDocumentCount() const;
 
         // Full result with matched words from document with status(if query contains minus words, function returns empty vector)
@@ -67,6 +99,8 @@ class SearchServer {
         struct Query {
             std::vector<std::string_view> plus_words; 
             std::vector<std::string_view> minus_words; 
+            std::vector<std::string_view> plus_prefixes; // prefix words without trailing '*'
+            std::vector<std::string_view> minus_prefixes; 
         };
 
         struct DocumentData {
@@ -80,7 +114,19 @@ class SearchServer {
 
         std::set<int> documents_id_;
 
-        std::map<std::string_view, std::map<int, double>> word_to_document_index_; // word : (document index : word term frequency in document)
+        // FindTopDocumentsBatch splits document ids into at most MAX_BATCH_SHARD_COUNT shards of at least MIN_BATCH_SHARD_SIZE documents
+        inline static constexpr size_t MAX_BATCH_SHARD_COUNT = 16;
+        inline static constexpr size_t MIN_BATCH_SHARD_SIZE = 256;
+
+        // Rating and status are copied into every posting of the document, so filters are checked without lookups
+        struct Posting {
+            double term_frequency;
+            int rating;
+            DocumentStatus status;
+        };
+
+        TermDictionary terms_; // word : term id
+        std::vector<std::map<int, Posting>> word_to_document_index_; // term id : (document index : posting)
         std::map<int, std::map<std::string_view, double>> document_to_word_index_; // document index : (word : word term frequency in document)
 
         std::set<std::string_view, std::less<>> stop_words_;
@@ -89,14 +135,39 @@ class SearchServer {
 
         std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
 
+        // Checks whether query word is a prefix word like "pet*"
+        static bool IsPrefixWord(std::string_view word);
+
         Query ParseQuery(std::string_view text, bool do_sort = false) const;
 
+        // Sorts documents by relevance (then by rating) and keeps MAX_RESULT_DOCUMENT_COUNT best of them
+        static void SortTopDocuments(std::vector<Document>& documents);
+
         static int ComputeAverageRating(const std::vector<int>& ratings);
 
-        double ComputeWordIDF(std::string_view word) const;
+        double ComputeWordIDF(TermDictionary::TermId term) const;
 
+        // Sorted unique term ids of the index words and of the expansions of the prefixes,
+        // every prefix is expanded to at most max_expansion_count terms
+        std::vector<TermDictionary::TermId> ResolveTerms(const std::vector<std::string_view>& words, 
+                                                        const std::vector<std::string_view>& prefixes,
+                                                        size_t max_expansion_count) const;
+
+        static bool HasWordWithPrefix(const std::map<std::string_view, double>& document_words, std::string_view prefix);
+
+        // Words of the document matching plus prefixes, limited to the same prefix expansions FindTopDocuments uses
+        void CollectWordsWithPrefixes(const std::map<std::string_view, double>& document_words, 
+                                        const std::vector<std::string_view>& prefixes, std::vector<std::string_view>& words) const;
+
+        // Filter is called with the document data stored in every scanned posting
         template <typename Function>
-        std::vector<Document> FindAllDocuments(const Query& query_words, Function CheckFilter) const;
+        SearchResult FindAllDocuments(const Query& query_words, Function CheckFilter, QueryBudget& budget) const;
+
+        template <typename DocumentPredicate>
+        SearchResult FindAcceptedDocuments(const Query& query_words, DocumentPredicate IsAccepted, QueryBudget& budget) const;
+
+        // Removes documents containing any of minus terms
+        void ExcludeDocuments(std::map<int, double>& matched_documents, const std::vector<TermDictionary::TermId>& minus_terms) const;
 };
 
 template <typename T>
@@ -116,52 +187,79 @@ SearchServer::SearchServer(const T& stop_words_set) {
 
 template <typename Function>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, Function FilterDocument) const {
+    QueryBudget unlimited_budget;
+    return FindTopDocuments(raw_query, FilterDocument, unlimited_budget).documents;
+}
+
+template <typename Function>
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, Function FilterDocument, QueryBudget& budget) const {
     Query parsed_query = ParseQuery(raw_query, true);
 
-    std::vector<Document> top_documents = FindAllDocuments(parsed_query, FilterDocument);
-    
-    const double EPSILON = 1e-6;
+    SearchResult result = FindAllDocuments(parsed_query, FilterDocument, budget);
 
-    sort(top_documents.begin(), top_documents.end(), 
-        [EPSILON](const Document& el1, const Document& el2){
-            return el1.relevance > el2.relevance || 
-            (std::abs(el1.relevance - el2.relevance) < EPSILON && el1.rating > el2.rating) ;
-        });             
+    SortTopDocuments(result.documents);
 
-    if ( top_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        top_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-
-    return top_documents;
+    return result;
 }
 
 template <typename Function>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query_words, Function CheckFilter) const { 
+SearchResult SearchServer::FindAllDocuments(const Query& query_words, Function CheckFilter, QueryBudget& budget) const { 
+    return FindAcceptedDocuments(query_words, [&CheckFilter](int document_id, const Posting& posting) {
+        return CheckFilter(document_id, posting.status, posting.rating);
+    }, budget);
+}
+
+template <typename DocumentPredicate>
+SearchResult SearchServer::FindAcceptedDocuments(const Query& query_words, DocumentPredicate IsAccepted, QueryBudget& budget) const { 
     std::map<int,double> matched_documents; // [id, relevance]
+    SearchResult result;
+
+    std::vector<TermDictionary::TermId> plus_terms = ResolveTerms(query_words.plus_words, query_words.plus_prefixes, MAX_PREFIX_EXPANSION_COUNT);
+    if (budget.IsLimited()) {
+        // Rare words have the highest IDF, scanning them first makes partial results as good as possible
+        std::stable_sort(plus_terms.begin(), plus_terms.end(), 
+            [this](TermDictionary::TermId term1, TermDictionary::TermId term2) {
+                return word_to_document_index_[term1].size() < word_to_document_index_[term2].size();
+            });
+    }
 
-    for (std::string_view query_word : query_words.plus_words) {
-        if (word_to_document_index_.count(query_word)) {
-            double word_IDF = ComputeWordIDF(query_word);
-            for (const auto& [id, word_TF] : word_to_document_index_.at(query_word)) {  
-                DocumentData document_info = documents_.at(id); 
-                if (CheckFilter(id, document_info.status, document_info.rating)) {
-                    matched_documents[id] += word_TF * word_IDF;
+    for (TermDictionary::TermId term : plus_terms) {
+        if (word_to_document_index_[term].empty()) {
+            continue;
+        }
+        if (budget.IsExhausted()) {
+            result.is_partial = true;
+            break;
+        }
+        double word_IDF = ComputeWordIDF(term);
+        const std::map<int, Posting>& postings = word_to_document_index_[term];
+        size_t scanned_postings = 0;
+        // Every block of postings is charged once it is scored, the query is partial
+        // only if the budget runs out while some postings of the term are left
+        for (auto it = postings.begin(); it != postings.end();) {
+            const auto& [id, posting] = *it++;
+            if (IsAccepted(id, posting)) {
+                matched_documents[id] += posting.term_frequency * word_IDF;
+            }
+            if (++scanned_postings == QueryBudget::CHECK_INTERVAL) {
+                scanned_postings = 0;
+                if (!budget.Consume(QueryBudget::CHECK_INTERVAL) && it != postings.end()) {
+                    result.is_partial = true;
+                    break;
                 }
             }
         }
-    }
-
-    for (std::string_view minus_word : query_words.minus_words) {
-        if (word_to_document_index_.count(minus_word)) {
-            for (const auto& [id, word_TF]: word_to_document_index_.at(minus_word)) {
-                matched_documents.erase(id);
-            }
+        if (result.is_partial) {
+            break;
         }
+        budget.Consume(scanned_postings);
     }
 
-    std::vector<Document> result;
+    // Minus words are applied even to partial results
+    ExcludeDocuments(matched_documents, ResolveTerms(query_words.minus_words, query_words.minus_prefixes, NO_EXPANSION_LIMIT));
+
     for (const auto& [id, relevance] : matched_documents) {
-        result.push_back({id, relevance, documents_.at(id).rating});
+        result.documents.push_back({id, relevance, documents_.at(id).rating});
     }
 
     return result;
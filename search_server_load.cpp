@@ -0,0 +1,218 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark_utils.h"
+
+using namespace std;
+
+// Loopback load generator for search_serverd: fills the server with synthetic documents, then keeps
+// a fixed number of pipelined FIND requests in flight on every connection and reports QPS and latency.
+// Usage: search_server_load [port] [connections] [pipeline depth] [seconds] [documents]
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+const int FILL_WINDOW = 256;
+
+class Client {
+    public:
+        explicit Client(uint16_t port) {
+            fd_ = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (fd_ < 0 || connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+                throw runtime_error("Can't connect to port "s + to_string(port));
+            }
+            const int enable = 1;
+            setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
+
+        ~Client() {
+            close(fd_);
+        }
+
+        void Send(const string& request) {
+            const string line = request + '\n';
+            size_t sent = 0;
+            while (sent < line.size()) {
+                const ssize_t size = send(fd_, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+                if (size <= 0) {
+                    throw runtime_error("Connection is lost"s);
+                }
+                sent += size;
+            }
+        }
+
+        string ReadLine() {
+            for (;;) {
+                if (const size_t end = input_.find('\n'); end != string::npos) {
+                    string line = input_.substr(0, end);
+                    input_.erase(0, end + 1);
+                    return line;
+                }
+                char buffer[64 * 1024];
+                const ssize_t size = recv(fd_, buffer, sizeof(buffer), 0);
+                if (size <= 0) {
+                    throw runtime_error("Connection is lost"s);
+                }
+                input_.append(buffer, size);
+            }
+        }
+
+    private:
+        int fd_ = -1;
+        string input_;
+};
+
+// Server stops reading requests of a client that doesn't read responses, so only a window of ADDs is kept in flight
+void FillServer(uint16_t port, int document_count, const vector<string>& dictionary) {
+    Client client(port);
+    mt19937 generator(0);
+    ZipfGenerator word_popularity(dictionary.size(), 1.0);
+
+    auto check_response = [&client] {
+        const string response = client.ReadLine();
+        if (response != "OK"s) {
+            throw runtime_error("Can't add document: "s + response);
+        }
+    };
+
+    for (int id = 0; id < document_count; ++id) {
+        if (id >= FILL_WINDOW) {
+            check_response();
+        }
+        client.Send("ADD "s + to_string(id) + " 0 1,2,3 "s + GenerateText(generator, dictionary, word_popularity, 40));
+    }
+    for (int i = 0; i < min(document_count, FILL_WINDOW); ++i) {
+        check_response();
+    }
+}
+
+// Returns latencies of all requests in microseconds
+vector<int64_t> RunConnection(uint16_t port, size_t pipeline_depth, Clock::time_point deadline, 
+                              const vector<string>& dictionary, uint32_t seed) {
+    Client client(port);
+    mt19937 generator(seed);
+    ZipfGenerator word_popularity(dictionary.size(), 1.0);
+
+    vector<int64_t> latencies;
+    deque<Clock::time_point> sent_times;
+
+    auto send_request = [&] {
+        const size_t word_count = uniform_int_distribution<size_t>(1, 5)(generator);
+        client.Send("FIND "s + GenerateText(generator, dictionary, word_popularity, word_count, 0.1));
+        sent_times.push_back(Clock::now());
+    };
+
+    for (size_t i = 0; i < pipeline_depth; ++i) {
+        send_request();
+    }
+
+    while (!sent_times.empty()) {
+        const string response = client.ReadLine();
+        const Clock::time_point now = Clock::now();
+        if (response.rfind("OK"s, 0) != 0) {
+            throw runtime_error("Request failed: "s + response);
+        }
+        latencies.push_back(chrono::duration_cast<chrono::microseconds>(now - sent_times.front()).count());
+        sent_times.pop_front();
+
+        if (now < deadline) {
+            send_request();
+        }
+    }
+
+    return latencies;
+}
+
+int64_t Percentile(const vector<int64_t>& sorted_values, double percentile) {
+    const size_t index = static_cast<size_t>(ceil(percentile / 100 * sorted_values.size()));
+    return sorted_values[min(max<size_t>(index, 1), sorted_values.size()) - 1];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const uint16_t port = argc > 1 ? static_cast<uint16_t>(stoi(argv[1])) : 8080;
+    const size_t connection_count = argc > 2 ? stoul(argv[2]) : 8;
+    const size_t pipeline_depth = argc > 3 ? stoul(argv[3]) : 16;
+    const int seconds = argc > 4 ? stoi(argv[4]) : 10;
+    const int document_count = argc > 5 ? stoi(argv[5]) : 10'000;
+
+    try {
+        // All connections share the vocabulary, their seeds only change the generated texts
+        mt19937 vocabulary_generator(42);
+        const vector<string> dictionary = GenerateDictionary(vocabulary_generator, 10'000, 8);
+
+        FillServer(port, document_count, dictionary);
+
+        const Clock::time_point start = Clock::now();
+        const Clock::time_point deadline = start + chrono::seconds(seconds);
+
+        vector<vector<int64_t>> connection_latencies(connection_count);
+        vector<thread> threads;
+        atomic<bool> failed = false;
+        for (size_t i = 0; i < connection_count; ++i) {
+            threads.emplace_back([&, i] {
+                try {
+                    connection_latencies[i] = RunConnection(port, pipeline_depth, deadline, dictionary, static_cast<uint32_t>(i + 1));
+                } catch (const exception& e) {
+                    cerr << e.what() << endl;
+                    failed = true;
+                }
+            });
+        }
+        for (thread& connection_thread : threads) {
+            connection_thread.join();
+        }
+        const double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+        if (failed) {
+            return 1;
+        }
+
+        vector<int64_t> latencies;
+        for (const vector<int64_t>& values : connection_latencies) {
+            latencies.insert(latencies.end(), values.begin(), values.end());
+        }
+        if (latencies.empty()) {
+            cout << "No requests were served"s << endl;
+            return 1;
+        }
+        sort(latencies.begin(), latencies.end());
+
+        cout << "requests: "s << latencies.size() << endl
+             << "QPS: "s << static_cast<int64_t>(latencies.size() / elapsed) << endl
+             << "latency p50: "s << Percentile(latencies, 50) << " us"s << endl
+             << "latency p90: "s << Percentile(latencies, 90) << " us"s << endl
+             << "latency p99: "s << Percentile(latencies, 99) << " us"s << endl
+             << "latency p99.9: "s << Percentile(latencies, 99.9) << " us"s << endl
+             << "latency max: "s << latencies.back() << " us"s << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "search_server.h"
+#include "query_server.h"
+
+using namespace std;
+
+// Usage: search_serverd [port] [worker count] [stop words]
+
+namespace {
+
+QueryServer* running_server = nullptr;
+
+void HandleStopSignal(int) {
+    if (running_server) {
+        running_server->Stop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const uint16_t port = argc > 1 ? static_cast<uint16_t>(stoi(argv[1])) : 8080;
+    const size_t worker_count = argc > 2 ? stoul(argv[2]) : max(thread::hardware_concurrency(), 1u);
+    const string stop_words = argc > 3 ? argv[3] : ""s;
+
+    try {
+        SearchServer search_server(stop_words);
+        QueryServer query_server(search_server, port, worker_count);
+
+        running_server = &query_server;
+        signal(SIGINT, HandleStopSignal);
+        signal(SIGTERM, HandleStopSignal);
+
+        cout << "Listening on 127.0.0.1:"s << port << " with "s << worker_count << " workers"s << endl;
+        query_server.Run();
+        running_server = nullptr;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,217 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+void WriteVarint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint32_t ReadVarint(const std::string& in, size_t& pos) {
+    uint32_t value = 0;
+    for (int shift = 0; ; shift += 7) {
+        const uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    return value;
+}
+
+// Sequentially decodes front-coded terms starting from the beginning of a block
+class BlockReader {
+    public:
+        BlockReader(const std::string& data, size_t begin)
+            : data_(data)
+            , pos_(begin) {
+        }
+
+        bool Next() {
+            if (pos_ >= data_.size()) {
+                return false;
+            }
+            const uint32_t shared = ReadVarint(data_, pos_);
+            const uint32_t suffix_size = ReadVarint(data_, pos_);
+            term_.resize(shared);
+            term_.append(data_, pos_, suffix_size);
+            pos_ += suffix_size;
+            id_ = ReadVarint(data_, pos_);
+            return true;
+        }
+
+        const std::string& Term() const {
+            return term_;
+        }
+
+        TermDictionary::TermId Id() const {
+            return id_;
+        }
+
+    private:
+        const std::string& data_;
+        size_t pos_;
+        std::string term_;
+        TermDictionary::TermId id_ = TermDictionary::NO_TERM;
+};
+
+bool StartsWith(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+} // namespace
+
+TermDictionary::TermId TermDictionary::Insert(std::string_view term) {
+    TermId id = Find(term);
+    if (id != NO_TERM) {
+        return id;
+    }
+
+    id = static_cast<TermId>(size());
+    pending_.emplace(std::string(term), id);
+
+    if (pending_.size() >= std::max(MIN_PENDING_TERMS, block_terms_count_ / 8)) {
+        Compact();
+    }
+    return id;
+}
+
+TermDictionary::TermId TermDictionary::Find(std::string_view term) const {
+    if (auto it = pending_.find(term); it != pending_.end()) {
+        return it->second;
+    }
+
+    const size_t block = FindBlock(term);
+    if (block == block_offsets_.size()) {
+        return NO_TERM;
+    }
+
+    BlockReader reader(data_, block_offsets_[block]);
+    for (size_t i = 0; i < BLOCK_SIZE && reader.Next(); ++i) {
+        if (reader.Term() == term) {
+            return reader.Id();
+        }
+        if (reader.Term() > term) {
+            break;
+        }
+    }
+    return NO_TERM;
+}
+
+std::vector<TermDictionary::TermId> TermDictionary::FindByPrefix(std::string_view prefix, size_t max_count, 
+                                                                const std::function<bool(TermId)>& accept_term) const {
+    std::vector<std::pair<std::string, TermId>> found;
+
+    size_t block = FindBlock(prefix);
+    if (block == block_offsets_.size()) {
+        block = 0;
+    }
+    if (block < block_offsets_.size()) {
+        BlockReader reader(data_, block_offsets_[block]);
+        while (found.size() < max_count && reader.Next()) {
+            if (reader.Term() < prefix) {
+                continue;
+            }
+            if (!StartsWith(reader.Term(), prefix)) {
+                break;
+            }
+            if (accept_term(reader.Id())) {
+                found.emplace_back(reader.Term(), reader.Id());
+            }
+        }
+    }
+
+    const size_t block_found_count = found.size();
+    for (auto it = pending_.lower_bound(prefix);
+            it != pending_.end() && found.size() - block_found_count < max_count && StartsWith(it->first, prefix); ++it) {
+        if (accept_term(it->second)) {
+            found.emplace_back(it->first, it->second);
+        }
+    }
+
+    std::inplace_merge(found.begin(), found.begin() + block_found_count, found.end());
+    if (found.size() > max_count) {
+        found.resize(max_count);
+    }
+
+    std::vector<TermId> result;
+    result.reserve(found.size());
+    for (const auto& [term, id] : found) {
+        result.push_back(id);
+    }
+    return result;
+}
+
+size_t TermDictionary::size() const {
+    return block_terms_count_ + pending_.size();
+}
+
+std::string_view TermDictionary::GetBlockFirstTerm(size_t block) const {
+    size_t pos = block_offsets_[block];
+    ReadVarint(data_, pos); // shared prefix length is always zero for the first term of a block
+    const uint32_t size = ReadVarint(data_, pos);
+    return std::string_view(data_).substr(pos, size);
+}
+
+size_t TermDictionary::FindBlock(std::string_view term) const {
+    size_t left = 0;
+    size_t right = block_offsets_.size();
+    // Looks for the last block whose first term is not greater than term
+    while (left < right) {
+        const size_t middle = left + (right - left) / 2;
+        if (GetBlockFirstTerm(middle) <= term) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+    return left == 0 ? block_offsets_.size() : left - 1;
+}
+
+void TermDictionary::Compact() {
+    std::vector<std::pair<std::string, TermId>> terms;
+    terms.reserve(size());
+
+    BlockReader reader(data_, 0);
+    while (reader.Next()) {
+        terms.emplace_back(reader.Term(), reader.Id());
+    }
+    const size_t block_terms_end = terms.size();
+    for (auto& [term, id] : pending_) {
+        terms.emplace_back(term, id);
+    }
+    std::inplace_merge(terms.begin(), terms.begin() + block_terms_end, terms.end());
+
+    std::string data;
+    std::vector<uint32_t> block_offsets;
+    std::string_view previous;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        const std::string_view term = terms[i].first;
+        size_t shared = 0;
+        if (i % BLOCK_SIZE == 0) {
+            block_offsets.push_back(static_cast<uint32_t>(data.size()));
+        } else {
+            const size_t max_shared = std::min(previous.size(), term.size());
+            while (shared < max_shared && previous[shared] == term[shared]) {
+                ++shared;
+            }
+        }
+        WriteVarint(data, static_cast<uint32_t>(shared));
+        WriteVarint(data, static_cast<uint32_t>(term.size() - shared));
+        data.append(term.substr(shared));
+        WriteVarint(data, terms[i].second);
+        previous = term;
+    }
+    data.shrink_to_fit();
+
+    data_ = std::move(data);
+    block_offsets_ = std::move(block_offsets);
+    block_terms_count_ = terms.size();
+    pending_.clear();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <map>
+#include <vector>
+
+// Sorted dictionary of index terms. Every term gets a stable TermId in insertion order.
+// Terms are kept front-coded in blocks of BLOCK_SIZE entries (each entry stores only
+// the suffix that differs from the previous term), fresh terms are collected in a small
+// sorted buffer and merged into the blocks once the buffer grows large enough.
+class TermDictionary {
+    public:
+        using TermId = uint32_t;
+
+        // Returned by Find when the term is absent
+        inline static constexpr TermId NO_TERM = UINT32_MAX;
+
+        // Returns id of the term, adding it to the dictionary if needed
+        TermId Insert(std::string_view term);
+
+        TermId Find(std::string_view term) const;
+
+        // Ids of the terms starting with prefix, at most max_count lexicographically first ones
+        // among the terms accepted by accept_term (e.g. the terms still present in some document)
+        std::vector<TermId> FindByPrefix(std::string_view prefix, size_t max_count, 
+                                        const std::function<bool(TermId)>& accept_term) const;
+
+        size_t size() const;
+
+    private:
+        inline static constexpr size_t BLOCK_SIZE = 16;
+        inline static constexpr size_t MIN_PENDING_TERMS = 64;
+
+        std::string data_; // encoded blocks: [shared prefix length, suffix length, suffix, id] per term
+        std::vector<uint32_t> block_offsets_; // offset of every block in data_
+        size_t block_terms_count_ = 0;
+
+        std::map<std::string, TermId, std::less<>> pending_; // terms not yet merged into blocks
+
+        std::string_view GetBlockFirstTerm(size_t block) const;
+
+        // Index of the block that may contain term, or block_offsets_.size() if there is none
+        size_t FindBlock(std::string_view term) const;
+
+        void Compact();
+};